@@ -0,0 +1,82 @@
+/*********************************************************************************************\
+ * Host microbenchmark of the CSE7761 raw sample filters (components/cse7761/filters.h)
+ *
+ * filters.h has no ESPHome dependency, this file builds alone on the host:
+ *   make -C bench && ./bench/filters_bench
+ *
+ * Prints the cost per sample of each filter type and of the raw_filters example chain of
+ * sonoff_powct_*.yaml: CPU cycles (x86 TSC) when available, nanoseconds otherwise.
+ * Host figures only compare the chains with each other, they are not ESP32 cycles.
+ * \*********************************************************************************************/
+
+#include "../components/cse7761/filters.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_TSC 1
+#else
+#define HAS_TSC 0
+#endif
+
+using namespace esphome::cse7761;
+
+static const size_t SAMPLES = 4096;     // input buffer, replayed
+static const size_t ITERATIONS = 2000;  // replays per chain
+
+static volatile float sink;
+
+//***********************************************************************************************
+// bench : run the chain on ITERATIONS * SAMPLES samples and print the cost of one sample
+//***********************************************************************************************
+template<typename Chain> void bench(const char *name, const std::vector<float> &input) {
+  Chain chain;
+  float accumulator = 0;
+  auto start = std::chrono::steady_clock::now();
+#if HAS_TSC
+  uint64_t start_cycles = __rdtsc();
+#endif
+  for (size_t iteration = 0; iteration < ITERATIONS; iteration++) {
+    for (float value : input) {
+      accumulator += chain.apply(value);
+    }
+  }
+#if HAS_TSC
+  uint64_t cycles = __rdtsc() - start_cycles;
+#endif
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  sink = accumulator;
+
+  double samples = double(ITERATIONS) * SAMPLES;
+#if HAS_TSC
+  printf("%-48s %8.2f cycles/sample %8.2f ns/sample\n", name, cycles / samples, ns / samples);
+#else
+  printf("%-48s %8.2f ns/sample\n", name, ns / samples);
+#endif
+}
+
+int main() {
+  // channel A current like input: idle noise around 0 with load steps
+  std::mt19937 generator(7761);
+  std::normal_distribution<float> noise(0.0f, 0.02f);
+  std::vector<float> input(SAMPLES);
+  for (size_t i = 0; i < SAMPLES; i++) {
+    input[i] = ((i / 512) % 2 ? 6.5f : 0.0f) + noise(generator);
+  }
+
+  bench<FilterChain<>>("none", input);
+  bench<FilterChain<MovingAverageFilter<8>>>("moving_average: 8", input);
+  bench<FilterChain<MovingAverageFilter<64>>>("moving_average: 64", input);
+  bench<FilterChain<ExponentialFilter<300000>>>("exponential: 0.3", input);
+  bench<FilterChain<MedianFilter<3>>>("median: 3", input);
+  bench<FilterChain<MedianFilter<5>>>("median: 5", input);
+  bench<FilterChain<MedianFilter<9>>>("median: 9", input);
+  bench<FilterChain<DeadZoneFilter<10000>>>("dead_zone: 0.01", input);
+  bench<FilterChain<MedianFilter<5>, ExponentialFilter<300000>, DeadZoneFilter<10000>>>(
+      "median: 5, exponential: 0.3, dead_zone: 0.01", input);
+  return 0;
+}
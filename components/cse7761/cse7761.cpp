@@ -1,7 +1,12 @@
 #include "cse7761.h"
 
+#include "esphome/core/helpers.h"
 #include "esphome/core/log.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cerrno>
+#include <cstring>
 #include <sstream>
 #include <iomanip>
 #include <inttypes.h>
@@ -59,8 +64,54 @@ namespace esphome {
     static const uint8_t CSE7761_CMD_CLOSE_WRITE = 0xDC;   // Close write operation
     static const uint8_t CSE7761_CMD_ENABLE_WRITE = 0xE5;  // Enable write operation
 
+    // Batch register access (read_registers / write_registers services)
+    static const size_t REGISTER_BATCH_MAX_ENTRIES = 32;  // 32 * 5 bytes of answers fit in the UART RX buffer
+    static const char *const REGISTER_READ_EVENT = "esphome.cse7761_read_registers";
+    static const char *const REGISTER_WRITE_EVENT = "esphome.cse7761_write_registers";
+
+    // Adaptive polling: back-off factor applied to the update interval on each steady sample
+    static const float ADAPTIVE_BACKOFF_FACTOR = 1.5f;
+
+    // Fast sampling path (protection, load events): the chip updates its measurements at 27.2Hz,
+    // no need to sample faster
+    static const uint32_t FAST_SAMPLE_INTERVAL = 37;  // ms
+    static const char *const PROTECTION_TRIP_EVENT = "esphome.cse7761_protection_trip";
+    static const uint32_t PROTECTION_MAX_READ_FAILURES = 3;  // consecutive fast path failures before a trip
+
+    // Load events: CUSUM drift = threshold / 2, alarm = threshold * LOAD_EVENT_ALARM_FACTOR
+    static const float LOAD_EVENT_ALARM_FACTOR = 2.0f;
+    static const float LOAD_BASELINE_ALPHA = 1.0f / 64.0f;  // steady-state tracking between events
+    static const char *const LOAD_EVENT = "esphome.cse7761_load_event";
+
+    // Measurements streaming
+    static const uint8_t STREAM_FLAG_RAW = 0x01;
+
     enum CSE7761 { RMS_IAC, RMS_IBC, RMS_UC, POWER_PAC, POWER_PBC, POWER_SC, ENERGY_AC, ENERGY_BC };
 
+    //***********************************************************************************************
+    // append_frame : append one "0xA5 + reg + data + CRC" frame to a batch buffer
+    // - uint8_t reg : register address (| 0x80 to write)
+    // - uint16_t data : data to write
+    // - uint8_t len : number of data bytes (0 for a read command)
+    //***********************************************************************************************
+    static void append_frame(std::vector<uint8_t> &frames, uint8_t reg, uint16_t data, uint8_t len) {
+      if (len == 0) {
+        // read command: no data, no CRC
+        frames.push_back(0xA5);
+        frames.push_back(reg);
+        return;
+      }
+      uint8_t crc = 0xA5 + reg;
+      frames.push_back(0xA5);
+      frames.push_back(reg);
+      for (int i = len - 1; i >= 0; i--) {
+        uint8_t byte_value = (data >> (i * 8)) & 0xFF;
+        frames.push_back(byte_value);
+        crc += byte_value;
+      }
+      frames.push_back(~crc);
+    }
+
     //***********************************************************************************************
     // setup: starting routine
     //***********************************************************************************************
@@ -87,6 +138,12 @@ namespace esphome {
           this->accumulated_energy_received_ = 0.0f;
           this->accumulated_energy_exported_ = 0.0f;
         }
+        if (this->sampling_rate_sensor_ != nullptr) {
+          this->sampling_rate_sensor_->publish_state(1000.0f / this->get_update_interval());
+        }
+        if (this->stream_port_ != 0) {
+          this->stream_setup_();
+        }
       } else {
         this->mark_failed();
       }
@@ -153,6 +210,25 @@ namespace esphome {
         ESP_LOGE(TAG, ESP_LOG_MSG_COMM_FAIL);
       }
       LOG_UPDATE_INTERVAL(this);
+      if (this->adaptive_polling_) {
+        ESP_LOGCONFIG(TAG, "  Adaptive polling: %" PRIu32 " ms to %" PRIu32 " ms, threshold %.1f W, probe %" PRIu32 " ms",
+                      this->adaptive_min_interval_, this->adaptive_max_interval_, this->power_step_threshold_,
+                      this->adaptive_probe_interval_);
+      }
+      if (this->protection_enabled_()) {
+        ESP_LOGCONFIG(TAG, "  Protection: %.2f A, %.1f W (0 = disabled), trip delay %" PRIu32 " ms, hysteresis %.0f%%",
+                      this->protection_current_threshold_, this->protection_power_threshold_,
+                      this->protection_trip_delay_, this->protection_hysteresis_ * 100.0f);
+      }
+      if (this->load_events_enabled_) {
+        ESP_LOGCONFIG(TAG, "  Load events: %.1f W steps, settle time %" PRIu32 " ms", this->load_event_threshold_,
+                      this->load_event_settle_time_);
+      }
+      if (this->stream_port_ != 0) {
+        ESP_LOGCONFIG(TAG, "  Streaming to %s:%u, %u samples or %" PRIu32 " ms per datagram, %s values",
+                      this->stream_host_.c_str(), this->stream_port_, this->stream_batch_size_, this->stream_max_delay_,
+                      this->stream_raw_ ? "raw" : "scaled");
+      }
       this->check_uart_settings(38400, 1, uart::UART_CONFIG_PARITY_EVEN, 8);
     }
 
@@ -168,6 +244,368 @@ namespace esphome {
       if (this->data_.ready) {this->get_data_();}
     }
 
+    //***********************************************************************************************
+    // adapt_update_interval_ : adaptive polling. Go straight to the minimum interval when channel
+    // A active power moves more than the threshold between two samples, slowly back off to the
+    // maximum interval when it is steady (below half the threshold: noise floor), keep the
+    // interval in between. The step does not depend on the interval, unlike a dP/dt.
+    // - double power_step : |ΔP| of channel A active power between two samples (W), unfiltered
+    //***********************************************************************************************
+    void CSE7761Component::adapt_update_interval_(double power_step) {
+      uint32_t interval = this->get_update_interval();
+      uint32_t new_interval = interval;
+      if (power_step >= this->power_step_threshold_) {
+        new_interval = this->adaptive_min_interval_;
+      } else if (power_step < this->power_step_threshold_ / 2.0f) {
+        new_interval = std::min(this->adaptive_max_interval_, (uint32_t) (interval * ADAPTIVE_BACKOFF_FACTOR));
+      }
+      new_interval = std::max(new_interval, this->adaptive_min_interval_);
+      if (new_interval == interval) {
+        return;
+      }
+
+      ESP_LOGV(TAG, "dP = %.1f W, update interval %" PRIu32 " ms -> %" PRIu32 " ms", power_step, interval,
+               new_interval);
+      this->set_update_interval(new_interval);
+      this->start_poller();
+      if (this->sampling_rate_sensor_ != nullptr) {
+        this->sampling_rate_sensor_->publish_state(1000.0f / new_interval);
+      }
+    }
+
+    //***********************************************************************************************
+    // stream_setup_ : open the UDP socket used to stream measurements to stream_host_:stream_port_
+    //***********************************************************************************************
+    void CSE7761Component::stream_setup_() {
+      this->stream_socket_ = socket::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+      if (this->stream_socket_ == nullptr) {
+        ESP_LOGE(TAG, "Could not create streaming socket");
+        return;
+      }
+      this->stream_socket_->setblocking(false);
+      this->stream_addr_len_ = socket::set_sockaddr((struct sockaddr *) &this->stream_addr_, sizeof(this->stream_addr_),
+                                                    this->stream_host_, this->stream_port_);
+      if (this->stream_addr_len_ == 0) {
+        ESP_LOGE(TAG, "Invalid streaming address %s", this->stream_host_.c_str());
+        this->stream_socket_ = nullptr;
+        return;
+      }
+      this->stream_buffer_.reserve(sizeof(StreamHeaderStruct) + this->stream_batch_size_ * sizeof(StreamSampleStruct));
+    }
+
+    //***********************************************************************************************
+    // stream_sample_ : add the last measurements to the streaming buffer and send the datagram
+    // once stream_batch_size_ samples have been collected, or once the oldest one is
+    // stream_max_delay_ old (see also loop() for a batch that stops growing). A lost datagram is
+    // not sent again, the receiver sees it as a gap in the sequence numbers.
+    // - uint32_t now : measurement timestamp (ms)
+    //***********************************************************************************************
+    void CSE7761Component::stream_sample_(uint32_t now) {
+      if (this->stream_buffer_.empty()) {
+        StreamHeaderStruct header;
+        header.flags = this->stream_raw_ ? STREAM_FLAG_RAW : 0;
+        const uint8_t *header_bytes = reinterpret_cast<const uint8_t *>(&header);
+        this->stream_buffer_.insert(this->stream_buffer_.end(), header_bytes, header_bytes + sizeof(header));
+        this->stream_first_sample_time_ = now;
+      }
+
+      StreamSampleStruct sample;
+      sample.sequence = this->stream_sequence_++;
+      sample.timestamp = now;
+      if (this->stream_raw_) {
+        sample.voltage = this->data_.voltage_rms;
+        for (int i = 0; i < 2; i++) {
+          sample.current[i] = (uint32_t) this->data_.current_rms[i];
+          sample.active_power[i] = (uint32_t) this->data_.active_power[i];
+        }
+      } else {
+        float values[5] = {(float) this->voltage_, (float) this->active_current_A_, (float) this->active_current_B_,
+                           (float) this->active_power_A_, (float) this->active_power_B_};
+        memcpy(&sample.voltage, &values[0], sizeof(float));
+        memcpy(sample.current, &values[1], 2 * sizeof(float));
+        memcpy(sample.active_power, &values[3], 2 * sizeof(float));
+      }
+      const uint8_t *sample_bytes = reinterpret_cast<const uint8_t *>(&sample);
+      this->stream_buffer_.insert(this->stream_buffer_.end(), sample_bytes, sample_bytes + sizeof(sample));
+
+      StreamHeaderStruct *header = reinterpret_cast<StreamHeaderStruct *>(this->stream_buffer_.data());
+      header->count++;
+      if (header->count >= this->stream_batch_size_ || now - this->stream_first_sample_time_ >= this->stream_max_delay_) {
+        this->stream_flush_();
+      }
+    }
+
+    //***********************************************************************************************
+    // stream_flush_ : send the streaming buffer as one datagram, whatever the number of samples
+    //***********************************************************************************************
+    void CSE7761Component::stream_flush_() {
+      ssize_t sent = this->stream_socket_->sendto(this->stream_buffer_.data(), this->stream_buffer_.size(), 0,
+                                                  (struct sockaddr *) &this->stream_addr_, this->stream_addr_len_);
+      if (sent < 0) {
+        ESP_LOGV(TAG, "Streaming datagram not sent (errno %d)", errno);
+      }
+      this->stream_buffer_.clear();
+    }
+
+    //***********************************************************************************************
+    // loop : fast sampling path for protection and load events. Channel A current (only needed
+    // by the current protection) and power are sampled at the chip update rate, independently of
+    // update_interval and of the publish pipeline.
+    // Without them, adaptive polling can probe POWERPA alone every adaptive_probe_interval_ (0:
+    // off) while the update interval is above its minimum, so that a step is not missed during a
+    // long wait between two full updates.
+    //***********************************************************************************************
+    void CSE7761Component::loop() {
+      if (!this->data_.ready) {
+        return;
+      }
+      // with a long update interval a partial batch would wait for the next samples: send it
+      if (this->stream_socket_ != nullptr && !this->stream_buffer_.empty() &&
+          esphome::millis() - this->stream_first_sample_time_ >= this->stream_max_delay_) {
+        this->stream_flush_();
+      }
+      bool fast = this->protection_enabled_() || this->load_events_enabled_;
+      bool probe = this->adaptive_polling_ && this->adaptive_probe_interval_ > 0 &&
+                   this->get_update_interval() > this->adaptive_min_interval_;
+      if (!fast && !probe) {
+        return;
+      }
+      uint32_t now = esphome::millis();
+      if (now - this->last_fast_sample_time_ < (fast ? FAST_SAMPLE_INTERVAL : this->adaptive_probe_interval_)) {
+        return;
+      }
+      this->last_fast_sample_time_ = now;
+
+      // a failed read must not be taken for 0 A / 0 W: the sample is skipped and the protection
+      // trips after PROTECTION_MAX_READ_FAILURES consecutive failures (fail safe)
+      uint32_t uvalue = 0;
+      double current = 0;
+      bool ok = true;
+      if (this->protection_current_threshold_ > 0) {
+        ok = this->try_read_(CSE7761_REG_RMSIA, 3, &uvalue);
+        int32_t svalue = uvalue;
+        current = this->current_A_from_raw_((svalue & 0x800000) ? svalue | 0xFF000000 : svalue);
+      }
+      ok = ok && this->try_read_(CSE7761_REG_POWERPA, 4, &uvalue);
+      if (!ok) {
+        this->fast_read_failures_++;
+        ESP_LOGW(TAG, "Fast sampling read failed (%" PRIu32 " in a row)", this->fast_read_failures_);
+        if (this->protection_enabled_() && this->fast_read_failures_ == PROTECTION_MAX_READ_FAILURES &&
+            !this->protection_tripped_) {
+          ESP_LOGE(TAG, "Measurements lost, protection can't work");
+          this->overload_start_time_ = now;
+          // no good sample since boot: the latency clock can't start before this trip
+          uint32_t latency_start = this->last_protection_sample_time_ ? this->last_protection_sample_time_ : now;
+          this->trip_protection_(NAN, NAN, latency_start, "read_failure");
+        }
+        return;
+      }
+      this->fast_read_failures_ = 0;
+      double power = this->power_A_from_raw_(uvalue);
+      if (this->protection_enabled_()) {
+        this->check_protection_(current, power, now);
+      }
+      if (this->load_events_enabled_) {
+        this->detect_load_event_(power, now);
+      }
+      if (probe) {
+        double power_step = std::fabs(power - this->last_probe_power_);
+        this->last_probe_power_ = power;
+        if (power_step >= this->power_step_threshold_) {
+          ESP_LOGD(TAG, "Power step of %.1f W between updates", power_step);
+          this->adapt_update_interval_(power_step);
+        }
+      }
+    }
+
+    //***********************************************************************************************
+    // detect_load_event_ : step change detection on channel A active power (two-sided CUSUM).
+    // The steady-state before a step is tracked by a slow average, frozen while the CUSUM sums
+    // grow. Once a step is detected,
+    // the new steady-state is the mean of the second half of the settle time (inrush excluded)
+    // and an event is emitted if the step is at least load_event_threshold_.
+    // - double power : channel A active power (W), unfiltered
+    // - uint32_t now : sample time (ms)
+    //***********************************************************************************************
+    void CSE7761Component::detect_load_event_(double power, uint32_t now) {
+      if (!this->load_baseline_ready_) {
+        this->load_baseline_ = power;
+        this->load_baseline_ready_ = true;
+        return;
+      }
+
+      if (this->load_settling_) {
+        uint32_t elapsed = now - this->load_change_time_;
+        if (elapsed >= this->load_event_settle_time_ / 2) {
+          this->load_settle_sum_ += power;
+          this->load_settle_count_++;
+        }
+        if (elapsed < this->load_event_settle_time_ || this->load_settle_count_ == 0) {
+          return;
+        }
+        double after = this->load_settle_sum_ / this->load_settle_count_;
+        double delta = after - this->load_baseline_;
+        if (std::fabs(delta) >= this->load_event_threshold_) {
+          this->publish_load_event_(delta, this->load_baseline_, after);
+        }
+        this->load_baseline_ = after;
+        this->load_settling_ = false;
+        return;
+      }
+
+      double drift = this->load_event_threshold_ / 2.0f;
+      this->cusum_pos_ = std::max(0.0, this->cusum_pos_ + power - this->load_baseline_ - drift);
+      this->cusum_neg_ = std::max(0.0, this->cusum_neg_ + this->load_baseline_ - power - drift);
+      double alarm = this->load_event_threshold_ * LOAD_EVENT_ALARM_FACTOR;
+      if (this->cusum_pos_ > alarm || this->cusum_neg_ > alarm) {
+        this->load_settling_ = true;
+        this->load_change_time_ = now;
+        this->load_settle_sum_ = 0;
+        this->load_settle_count_ = 0;
+        this->cusum_pos_ = 0;
+        this->cusum_neg_ = 0;
+        return;
+      }
+      // the baseline is frozen while a CUSUM run is building up: following the new level would
+      // shrink the reported step (a step close to the threshold would then be dropped)
+      if (this->cusum_pos_ == 0 && this->cusum_neg_ == 0) {
+        this->load_baseline_ += (power - this->load_baseline_) * LOAD_BASELINE_ALPHA;
+      }
+    }
+
+    //***********************************************************************************************
+    // publish_load_event_ : send a load event as "esphome.cse7761_load_event" and to the optional
+    // last_event / last_delta entities. The event is sent settle_time after the step: age_ms lets
+    // the receiver date the step from its own clock (time_fired - age_ms)
+    //***********************************************************************************************
+    void CSE7761Component::publish_load_event_(double delta, double before, double after) {
+      ESP_LOGI(TAG, "Load event: %+.1f W (%.1f W -> %.1f W)", delta, before, after);
+      if (this->load_event_text_sensor_ != nullptr) {
+        this->load_event_text_sensor_->publish_state(str_sprintf("%+.1f W (%.1f W -> %.1f W)", delta, before, after));
+      }
+      if (this->load_event_delta_sensor_ != nullptr) {
+        this->load_event_delta_sensor_->publish_state(delta);
+      }
+      this->fire_homeassistant_event(LOAD_EVENT, {
+        {"uptime_ms", std::to_string(this->load_change_time_)},
+        {"age_ms", std::to_string(esphome::millis() - this->load_change_time_)},
+        {"delta", str_sprintf("%.1f", delta)},
+        {"before", str_sprintf("%.1f", before)},
+        {"after", str_sprintf("%.1f", after)},
+      });
+    }
+
+    //***********************************************************************************************
+    // current_A_from_raw_ / power_A_from_raw_ : channel A raw register value to A / W, software
+    // offset included, filters not applied
+    //***********************************************************************************************
+    double CSE7761Component::current_A_from_raw_(int32_t raw) {
+      return (((float) raw) / this->coefficient_by_unit_(RMS_IAC))/std::numbers::pi+this->software_current_offset_A_;
+    }
+
+    double CSE7761Component::power_A_from_raw_(int32_t raw) {
+      return (((float) raw) / this->coefficient_by_unit_(POWER_PAC))/std::numbers::pi+this->software_power_offset_A_;
+    }
+
+    //***********************************************************************************************
+    // check_protection_ : over-current / over-power detection on one raw sample. The overload
+    // must last protection_trip_delay_ to trip. It ends (and a trip is re-armed) only when both
+    // values go back below threshold * (1 - hysteresis).
+    // - double current : channel A current (A)
+    // - double power : channel A active power (W), both directions are checked
+    // - uint32_t now : sample time (ms)
+    //***********************************************************************************************
+    void CSE7761Component::check_protection_(double current, double power, uint32_t now) {
+      double abs_current = std::fabs(current);
+      double abs_power = std::fabs(power);
+      bool over = (this->protection_current_threshold_ > 0 && abs_current > this->protection_current_threshold_) ||
+                  (this->protection_power_threshold_ > 0 && abs_power > this->protection_power_threshold_);
+      // the overload began after the last sample below the thresholds: start of the latency clock
+      [[maybe_unused]] uint32_t previous_sample_time = this->last_protection_sample_time_ ? this->last_protection_sample_time_ : now;
+      this->last_protection_sample_time_ = now;
+      if (!over || this->last_safe_sample_time_ == 0) {
+        this->last_safe_sample_time_ = now;
+      }
+      float release = 1.0f - this->protection_hysteresis_;
+      bool current_released = this->protection_current_threshold_ <= 0 ||
+                              abs_current <= this->protection_current_threshold_ * release;
+      bool power_released = this->protection_power_threshold_ <= 0 ||
+                            abs_power <= this->protection_power_threshold_ * release;
+
+      if (current_released && power_released) {
+        if (this->protection_tripped_) {
+          ESP_LOGI(TAG, "Protection re-armed");
+        }
+        this->protection_tripped_ = false;
+        this->overload_ = false;
+        return;
+      }
+      if (!over) {
+        return;
+      }
+      if (this->protection_tripped_) {
+        // still overloaded after a trip: keep the relay off if it has been turned on again
+#ifdef USE_SWITCH
+        if (this->protection_switch_ != nullptr && this->protection_switch_->state) {
+          // the relay has been turned on again after the previous sample
+          this->overload_start_time_ = now;
+          this->trip_protection_(current, power, previous_sample_time, "overload");
+        }
+#endif
+#ifdef USE_OUTPUT
+        if (this->protection_output_ != nullptr) {
+          this->protection_output_->turn_off();
+        }
+#endif
+        return;
+      }
+      if (!this->overload_) {
+        this->overload_ = true;
+        this->overload_start_time_ = now;
+      }
+      if (now - this->overload_start_time_ >= this->protection_trip_delay_) {
+        this->trip_protection_(current, power, this->last_safe_sample_time_, "overload");
+      }
+    }
+
+    //***********************************************************************************************
+    // trip_protection_ : turn the linked relay off and report the trip latency. The overload
+    // started between the last sample below the thresholds and the first overloaded one, so
+    // the latency (from the former to the relay command) is an upper bound, and sample_gap is
+    // its uncertainty (time between these two samples).
+    // - uint32_t latency_start : time of the last sample below the thresholds (ms)
+    // - const char *reason : "overload" or "read_failure" (measurements lost)
+    //***********************************************************************************************
+    void CSE7761Component::trip_protection_(double current, double power, uint32_t latency_start,
+                                            const char *reason) {
+#ifdef USE_SWITCH
+      if (this->protection_switch_ != nullptr) {
+        this->protection_switch_->turn_off();
+      }
+#endif
+#ifdef USE_OUTPUT
+      if (this->protection_output_ != nullptr) {
+        this->protection_output_->turn_off();
+      }
+#endif
+      this->protection_tripped_ = true;
+      uint32_t latency = esphome::millis() - latency_start;
+      uint32_t sample_gap = this->overload_start_time_ - latency_start;
+
+      ESP_LOGW(TAG, "Protection tripped (%s): %.2f A, %.1f W, latency <= %" PRIu32 " ms (sample gap %" PRIu32 " ms)",
+               reason, current, power, latency, sample_gap);
+      if (this->trip_latency_sensor_ != nullptr) {
+        this->trip_latency_sensor_->publish_state(latency);
+      }
+      this->fire_homeassistant_event(PROTECTION_TRIP_EVENT, {
+        {"reason", reason},
+        {"current", str_sprintf("%.3f", current)},
+        {"power", str_sprintf("%.1f", power)},
+        {"latency_ms", std::to_string(latency)},
+        {"sample_gap_ms", std::to_string(sample_gap)},
+      });
+    }
+
     //***********************************************************************************************
     // write_ : write data "data" to rgister "reg"
     // - uint8_t reg : register address
@@ -255,18 +693,32 @@ namespace esphome {
     //       functions.
     //***********************************************************************************************
     uint32_t CSE7761Component::read_(uint8_t reg, uint8_t size) {
-      bool result = false;  // Start loop
-      uint8_t retry = 3;    // Retry up to three times
       uint32_t value = 0;   // Default no value
-      while (!result && retry > 0) {
-        retry--;
-        if (this->read_once_(reg, size, &value))
-          return value;
+      if (!this->try_read_(reg, size, &value)) {
+        ESP_LOGE(TAG, "Reading register %hhu failed!", reg);
       }
-      ESP_LOGE(TAG, "Reading register %hhu failed!", reg);
       return value;
     }
 
+    //***********************************************************************************************
+    // try_read_ : same as read_ but the failure is returned instead of a 0 value, for the callers
+    // that must not take a failed read for a measurement (protection)
+    // - uint8_t reg : register address
+    // - uint8_t size : register size
+    // - uint32_t *value : pointer to read data returned (0 on failure)
+    // return TRUE if OK, else return FALSE
+    //***********************************************************************************************
+    bool CSE7761Component::try_read_(uint8_t reg, uint8_t size, uint32_t *value) {
+      uint8_t retry = 3;    // Retry up to three times
+      *value = 0;
+      while (retry > 0) {
+        retry--;
+        if (this->read_once_(reg, size, value))
+          return true;
+      }
+      return false;
+    }
+
     //***********************************************************************************************
     // coefficient_by_unit_ : coef to convert row measurements
     // - uint32_t unit : index of measurements, see enum CSE7761
@@ -355,25 +807,34 @@ namespace esphome {
       // The active power parameter PowerA/B is in two’s complement format, 32-bit
       // data, the highest bit is Sign bit.
 
-      // TODO: add a new class member this->voltage, open the sonoff, connect it to serial
-      // without ac power and measure the noise to calibrate the tension
+      // Every measurement goes through its raw_filters chain (see filters.h) before being used.
+      // Channel B unfiltered values are kept for calibration.
+
+      // TODO: open the sonoff, connect it to serial without ac power and measure the noise to
+      // calibrate the tension
       uvalue = this->read_(CSE7761_REG_RMSU, 3);
       this->data_.voltage_rms = (uvalue >= 0x800000) ? 0 : uvalue;
-      float voltage = (float) this->data_.voltage_rms / this->coefficient_by_unit_(RMS_UC);
+      this->voltage_ = this->voltage_filter_.apply((float) this->data_.voltage_rms / this->coefficient_by_unit_(RMS_UC));
       if (this->voltage_sensor_ != nullptr) {
-        this->voltage_sensor_->publish_state(voltage);
+        this->voltage_sensor_->publish_state(this->voltage_);
       }
 
-      svalue = this->read_(CSE7761_REG_RMSIA, 3);
+      bool current_A_ok = this->try_read_(CSE7761_REG_RMSIA, 3, &uvalue);
+      if (!current_A_ok) {
+        ESP_LOGE(TAG, "Reading register %hhu failed!", CSE7761_REG_RMSIA);
+      }
+      svalue = uvalue;
       this->data_.current_rms[0] = (svalue&0x800000)?svalue|0xFF000000:svalue;
-      this->active_current_A_ = (((float) this->data_.current_rms[0]) / this->coefficient_by_unit_(RMS_IAC))/std::numbers::pi+this->software_current_offset_A_;
+      double current_A = this->current_A_from_raw_(this->data_.current_rms[0]);
+      this->active_current_A_ = this->current_1_filter_.apply(current_A);
       if (this->current_sensor_1_ != nullptr) {
         this->current_sensor_1_->publish_state(this->active_current_A_);
       }
 
       svalue = this->read_(CSE7761_REG_RMSIB, 3);
       this->data_.current_rms[1] = (svalue&0x800000)?svalue|0xFF000000:svalue;
-      this->active_current_B_ = (((float) this->data_.current_rms[1]) / this->coefficient_by_unit_(RMS_IBC))/std::numbers::pi+this->software_current_offset_B_;
+      double current_B = (((float) this->data_.current_rms[1]) / this->coefficient_by_unit_(RMS_IBC))/std::numbers::pi+this->software_current_offset_B_;
+      this->active_current_B_ = this->current_2_filter_.apply(current_B);
       if (this->current_sensor_2_ != nullptr) {
         this->current_sensor_2_->publish_state(this->active_current_B_);
       }
@@ -399,9 +860,21 @@ namespace esphome {
 //      float angle = (float) (frequency-50 < frequency-60) ? (0.0805*(float) this->data_.angle)  : (0.0965*(float) this->data_.angle);
 
       uint32_t now = esphome::millis();
-      svalue = this->read_(CSE7761_REG_POWERPA, 4);
-      this->data_.active_power[0] = (int32_t) svalue;
-      this->active_power_A_ = (((float) this->data_.active_power[0]) / this->coefficient_by_unit_(POWER_PAC))/std::numbers::pi+this->software_power_offset_A_;
+      bool power_A_ok = this->try_read_(CSE7761_REG_POWERPA, 4, &uvalue);
+      if (!power_A_ok) {
+        ESP_LOGE(TAG, "Reading register %hhu failed!", CSE7761_REG_POWERPA);
+      }
+      this->data_.active_power[0] = (int32_t) uvalue;
+      double power_A = this->power_A_from_raw_(this->data_.active_power[0]);
+      // a failed read gives 0: it must not be taken for a safe sample
+      if (this->protection_enabled_() && current_A_ok && power_A_ok) {
+        this->check_protection_(current_A, power_A, now);
+      }
+      if (this->adaptive_polling_ && power_A_ok) {
+        this->adapt_update_interval_(std::fabs(power_A - this->last_probe_power_));
+        this->last_probe_power_ = power_A;
+      }
+      this->active_power_A_ = this->active_power_1_filter_.apply(power_A);
       ESP_LOGD(TAG, "Puissance: %f", this->active_power_A_);
       if (this->power_sensor_1_ != nullptr) {
         this->power_sensor_1_->publish_state(this->active_power_A_);
@@ -414,6 +887,7 @@ namespace esphome {
       else{
         double time_delta_s = ((double)now - this->last_update_time_) / 1000.0f;
         this->last_update_time_ = (double) now;
+        // trapezoidal integration on the real time step: stays correct with a variable update interval
         double mean_power = (this->last_active_power_A_ + this->active_power_A_) / 2.0f;
         this->last_active_power_A_ = this->active_power_A_;
         // Energy = Power (W) * Delta Time (s) / 3600 (s/h) = Wh
@@ -438,7 +912,8 @@ namespace esphome {
 
       svalue = this->read_(CSE7761_REG_POWERPB, 4);
       this->data_.active_power[1] = (int32_t) svalue; // mesure du bruit
-      this->active_power_B_ = (((float) this->data_.active_power[1]) / this->coefficient_by_unit_(POWER_PBC))/std::numbers::pi+this->software_power_offset_B_;
+      double power_B = (((float) this->data_.active_power[1]) / this->coefficient_by_unit_(POWER_PBC))/std::numbers::pi+this->software_power_offset_B_;
+      this->active_power_B_ = this->active_power_2_filter_.apply(power_B);
       if (this->power_sensor_2_ != nullptr) {
         this->power_sensor_2_->publish_state(this->active_power_B_);
       }
@@ -467,8 +942,8 @@ namespace esphome {
           this->sum_power_B_ = 0;
         }
         // channel B always idle -> used for calibration
-        this->sum_current_B_ += this->active_current_B_;
-        this->sum_power_B_ += this->active_power_B_;
+        this->sum_current_B_ += current_B;
+        this->sum_power_B_ += power_B;
         this->calibration_count_++;
 
         if (this->calibration_count_ >= CALIBRATION_MEASUREMENTS) {
@@ -477,6 +952,10 @@ namespace esphome {
       }
 
 
+      if (this->stream_socket_ != nullptr) {
+        this->stream_sample_(now);
+      }
+
       // save every hour
       if (this->last_save_time_ == 0 || (esphome::millis() - this->last_save_time_) >= 3600000) {
         this->last_save_time_ = esphome::millis();
@@ -680,7 +1159,190 @@ namespace esphome {
       if (this->debug_sensor_bin_) {
         this->debug_sensor_bin_->publish_state(result_msg);
       }
-    }    
+    }
+
+    //***********************************************************************************************
+    // read_registers_service : home assistant service to read several registers in one call.
+    // All read commands are sent in one UART burst, answers are parsed in order and returned
+    // as a "esphome.cse7761_read_registers" event (value, status and latency of each entry).
+    // - std::vector<int32_t> registers : register addresses (0x00-0x7F)
+    // - std::vector<int32_t> sizes : register sizes in bytes (1-4), one per register
+    //***********************************************************************************************
+    void CSE7761Component::read_registers_service(std::vector<int32_t> registers, std::vector<int32_t> sizes) {
+      ESP_LOGD(TAG, "Service called: batch read of %u registers.", (unsigned) registers.size());
+
+      std::vector<RegisterResultStruct> results;
+      if (registers.empty() || registers.size() != sizes.size() || registers.size() > REGISTER_BATCH_MAX_ENTRIES) {
+        ESP_LOGE(TAG, "Error: %u registers for %u sizes (1 to %u entries expected)", (unsigned) registers.size(),
+                 (unsigned) sizes.size(), (unsigned) REGISTER_BATCH_MAX_ENTRIES);
+        this->fire_registers_event_(REGISTER_READ_EVENT, results);
+        return;
+      }
+
+      results.resize(registers.size());
+      for (size_t i = 0; i < registers.size(); i++) {
+        results[i].reg = registers[i];
+        if (registers[i] < 0 || registers[i] > 0x7F || sizes[i] < 1 || sizes[i] > 4) {
+          ESP_LOGE(TAG, "Error: invalid entry %u (register %" PRId32 ", size %" PRId32 ")", (unsigned) i, registers[i], sizes[i]);
+          continue;
+        }
+        results[i].size = sizes[i];
+        results[i].status = "pending";
+      }
+
+      std::vector<uint8_t> frames;
+      this->read_batch_(frames, results);
+      this->fire_registers_event_(REGISTER_READ_EVENT, results);
+    }
+
+    //***********************************************************************************************
+    // write_registers_service : home assistant service to write several 1 or 2 bytes registers in
+    // one call. Write enable, all the writes, write close and a read back of every written
+    // register are sent in one UART burst. The read back values are returned as a
+    // "esphome.cse7761_write_registers" event ("ok" when the register holds the written value).
+    // The size is needed for the read back: a wrong size shifts all the following answers.
+    // - std::vector<int32_t> registers : register addresses (0x00-0x7F, 0x80 is added)
+    // - std::vector<int32_t> values : values to write, one per register
+    // - std::vector<int32_t> sizes : register sizes in bytes (1-2), one per register
+    //***********************************************************************************************
+    void CSE7761Component::write_registers_service(std::vector<int32_t> registers, std::vector<int32_t> values,
+                                                   std::vector<int32_t> sizes) {
+      ESP_LOGD(TAG, "Service called: batch write of %u registers.", (unsigned) registers.size());
+
+      std::vector<RegisterResultStruct> results;
+      if (registers.empty() || registers.size() != values.size() || registers.size() != sizes.size() ||
+          registers.size() > REGISTER_BATCH_MAX_ENTRIES) {
+        ESP_LOGE(TAG, "Error: %u registers for %u values and %u sizes (1 to %u entries expected)",
+                 (unsigned) registers.size(), (unsigned) values.size(), (unsigned) sizes.size(),
+                 (unsigned) REGISTER_BATCH_MAX_ENTRIES);
+        this->fire_registers_event_(REGISTER_WRITE_EVENT, results);
+        return;
+      }
+
+      std::vector<uint8_t> frames;
+      frames.reserve(4 + registers.size() * 7 + 4);
+      append_frame(frames, CSE7761_SPECIAL_COMMAND, CSE7761_CMD_ENABLE_WRITE, 1);
+
+      results.resize(registers.size());
+      for (size_t i = 0; i < registers.size(); i++) {
+        results[i].reg = registers[i];
+        if (registers[i] < 0 || registers[i] > 0x7F || sizes[i] < 1 || sizes[i] > 2 || values[i] < 0 ||
+            values[i] >= (1 << (8 * sizes[i]))) {
+          ESP_LOGE(TAG, "Error: invalid entry %u (register %" PRId32 ", value %" PRId32 ", size %" PRId32 ")",
+                   (unsigned) i, registers[i], values[i], sizes[i]);
+          continue;
+        }
+        append_frame(frames, registers[i] | 0x80, values[i], sizes[i]);
+        results[i].value = values[i];
+        results[i].size = sizes[i];
+        results[i].status = "pending";
+      }
+
+      append_frame(frames, CSE7761_SPECIAL_COMMAND, CSE7761_CMD_CLOSE_WRITE, 1);
+
+      std::vector<uint32_t> written(results.size());
+      for (size_t i = 0; i < results.size(); i++) {
+        written[i] = results[i].value;
+      }
+      this->read_batch_(frames, results);
+      for (size_t i = 0; i < results.size(); i++) {
+        if (strcmp(results[i].status, "ok") == 0 && results[i].value != written[i]) {
+          results[i].status = "mismatch";
+        }
+      }
+      this->fire_registers_event_(REGISTER_WRITE_EVENT, results);
+    }
+
+    //***********************************************************************************************
+    // read_batch_ : pipelined register reads. A read command is appended to "frames" for every
+    // "pending" entry, everything is sent at once then the answers are parsed in the same order.
+    // After a timeout or a CRC error (usually a wrong size) the answers can't be aligned anymore:
+    // the remaining entries are "aborted" and the remaining answers are dropped.
+    // - std::vector<uint8_t> &frames : frames to send before the read commands (may be empty)
+    // - std::vector<RegisterResultStruct> &results : entries to read, updated in place
+    //***********************************************************************************************
+    void CSE7761Component::read_batch_(std::vector<uint8_t> &frames, std::vector<RegisterResultStruct> &results) {
+      for (auto &result : results) {
+        if (strcmp(result.status, "pending") == 0) {
+          append_frame(frames, result.reg, 0, 0);
+        }
+      }
+      if (frames.empty()) {
+        return;
+      }
+
+      while (this->available()) {
+        this->read();
+      }
+      uint32_t start = esphome::micros();
+      this->write_array(frames);
+
+      bool aligned = true;
+      uint32_t dropped_bytes = 0;
+      for (auto &result : results) {
+        if (strcmp(result.status, "pending") != 0) {
+          continue;
+        }
+        if (!aligned) {
+          result.status = "aborted";
+          dropped_bytes += result.size + 1;
+          continue;
+        }
+        uint8_t buffer[5] = {0};
+        bool received = this->read_array(buffer, result.size + 1);
+        result.latency_us = esphome::micros() - start;
+        if (!received) {
+          result.status = "timeout";
+          aligned = false;
+          continue;
+        }
+        uint8_t crc = 0xA5 + result.reg;
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < result.size; i++) {
+          value = (value << 8) | buffer[i];
+          crc += buffer[i];
+        }
+        crc = ~crc;
+        if (crc != buffer[result.size]) {
+          result.status = "crc_error";
+          aligned = false;
+          continue;
+        }
+        result.value = value;
+        result.status = "ok";
+      }
+
+      if (!aligned) {
+        // let the chip finish its answers (11 bits per byte at 38400 bauds) before dropping them
+        uint32_t drain_end = esphome::millis() + (dropped_bytes * 11 * 1000) / 38400 + 5;
+        while ((int32_t) (esphome::millis() - drain_end) < 0) {
+          while (this->available()) {
+            this->read();
+          }
+        }
+      }
+    }
+
+    //***********************************************************************************************
+    // fire_registers_event_ : send batch results to home assistant as one event. Entry "i" is
+    // described by the "register_i", "value_i", "status_i" and "latency_us_i" keys.
+    //***********************************************************************************************
+    void CSE7761Component::fire_registers_event_(const std::string &event_name,
+                                                 const std::vector<RegisterResultStruct> &results) {
+      std::map<std::string, std::string> data;
+      data["count"] = std::to_string(results.size());
+      for (size_t i = 0; i < results.size(); i++) {
+        const RegisterResultStruct &result = results[i];
+        std::string index = std::to_string(i);
+        data["register_" + index] = str_sprintf("0x%02X", (unsigned) result.reg);
+        data["value_" + index] = str_sprintf("0x%0*X", result.size * 2, (unsigned) result.value);
+        data["status_" + index] = result.status;
+        data["latency_us_" + index] = std::to_string(result.latency_us);
+        ESP_LOGI(TAG, "Register 0x%02X: 0x%0*X (%s, %u us)", (unsigned) result.reg, result.size * 2,
+                 (unsigned) result.value, result.status, (unsigned) result.latency_us);
+      }
+      this->fire_homeassistant_event(event_name, data);
+    }
 
   }  // namespace cse7761
 }  // namespace esphome
@@ -1,14 +1,43 @@
 #pragma once
 
+#include "esphome/core/defines.h"
 #include "esphome/components/api/custom_api_device.h"
 #include "esphome/components/api/api_server.h"
 #include "esphome/components/sensor/sensor.h"
+#include "esphome/components/socket/socket.h"
+#ifdef USE_SWITCH
+#include "esphome/components/switch/switch.h"
+#endif
+#ifdef USE_OUTPUT
+#include "esphome/components/output/binary_output.h"
+#endif
 #include "esphome/components/text_sensor/text_sensor.h"
 #include "esphome/components/uart/uart.h"
 #include "esphome/core/component.h"
 #include "esphome/core/preferences.h"
+#include <map>
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "filters.h"
+
+// Raw sample filter chains, defined by sensor.py from the "raw_filters" options
+#ifndef CSE7761_VOLTAGE_FILTERS
+#define CSE7761_VOLTAGE_FILTERS
+#endif
+#ifndef CSE7761_CURRENT_1_FILTERS
+#define CSE7761_CURRENT_1_FILTERS
+#endif
+#ifndef CSE7761_CURRENT_2_FILTERS
+#define CSE7761_CURRENT_2_FILTERS
+#endif
+#ifndef CSE7761_ACTIVE_POWER_1_FILTERS
+#define CSE7761_ACTIVE_POWER_1_FILTERS
+#endif
+#ifndef CSE7761_ACTIVE_POWER_2_FILTERS
+#define CSE7761_ACTIVE_POWER_2_FILTERS
+#endif
 
 namespace esphome {
   namespace cse7761 {
@@ -30,6 +59,34 @@ namespace esphome {
       double exported;
     };
 
+    // One entry of a batch register read/write, returned to Home Assistant as an event
+    struct RegisterResultStruct {
+      int32_t reg = 0;
+      uint32_t value = 0;
+      uint8_t size = 0;
+      const char *status = "invalid";
+      uint32_t latency_us = 0;
+    };
+
+    // Streaming datagram header (little endian), followed by "count" StreamSampleStruct
+    struct StreamHeaderStruct {
+      uint16_t magic = 0x7761;
+      uint8_t version = 1;
+      uint8_t flags = 0;  // bit 0: raw register values instead of float USI values
+      uint8_t count = 0;
+      uint8_t reserved[3] = {0};
+    };
+
+    // One streamed measurement: voltage, current and power slots hold either raw register
+    // values (int32_t) or scaled values (float) depending on the header flags
+    struct StreamSampleStruct {
+      uint32_t sequence;
+      uint32_t timestamp;  // ms since boot
+      uint32_t voltage;
+      uint32_t current[2];
+      uint32_t active_power[2];
+    };
+
     /// This class implements support for the CSE7761 UART power sensor.
     class CSE7761Component : public PollingComponent, public uart::UARTDevice, public api::CustomAPIDevice {
     public:
@@ -40,7 +97,44 @@ namespace esphome {
       void set_current_2_sensor(sensor::Sensor *current_sensor_2) { current_sensor_2_ = current_sensor_2; }
       void set_energy_received_sensor(sensor::Sensor *energy_received) { energy_received_ = energy_received; }
       void set_energy_exported_sensor(sensor::Sensor *energy_exported) { energy_exported_ = energy_exported; }
+      void set_sampling_rate_sensor(sensor::Sensor *sampling_rate) { sampling_rate_sensor_ = sampling_rate; }
+      void set_adaptive_polling(uint32_t min_interval, uint32_t max_interval, float power_step_threshold,
+                                uint32_t probe_interval) {
+        adaptive_polling_ = true;
+        adaptive_min_interval_ = min_interval;
+        adaptive_max_interval_ = max_interval;
+        power_step_threshold_ = power_step_threshold;
+        adaptive_probe_interval_ = probe_interval;
+      }
+      void set_stream(const std::string &host, uint16_t port, uint8_t batch_size, uint32_t max_delay, bool raw) {
+        stream_host_ = host;
+        stream_port_ = port;
+        stream_batch_size_ = batch_size;
+        stream_max_delay_ = max_delay;
+        stream_raw_ = raw;
+      }
+      void set_protection(float current_threshold, float power_threshold, uint32_t trip_delay, float hysteresis) {
+        protection_current_threshold_ = current_threshold;
+        protection_power_threshold_ = power_threshold;
+        protection_trip_delay_ = trip_delay;
+        protection_hysteresis_ = hysteresis;
+      }
+#ifdef USE_SWITCH
+      void set_protection_switch(switch_::Switch *protection_switch) { protection_switch_ = protection_switch; }
+#endif
+#ifdef USE_OUTPUT
+      void set_protection_output(output::BinaryOutput *protection_output) { protection_output_ = protection_output; }
+#endif
+      void set_trip_latency_sensor(sensor::Sensor *trip_latency) { trip_latency_sensor_ = trip_latency; }
+      void set_load_events(float threshold, uint32_t settle_time) {
+        load_events_enabled_ = true;
+        load_event_threshold_ = threshold;
+        load_event_settle_time_ = settle_time;
+      }
+      void set_load_event_text_sensor(text_sensor::TextSensor *last_event) { load_event_text_sensor_ = last_event; }
+      void set_load_event_delta_sensor(sensor::Sensor *last_delta) { load_event_delta_sensor_ = last_delta; }
       void setup() override;
+      void loop() override;
       void dump_config() override;
       float get_setup_priority() const override;
       void update() override;
@@ -49,6 +143,9 @@ namespace esphome {
       void set_debug_text_sensor_bin(text_sensor::TextSensor *debug_sensor_bin) { debug_sensor_bin_ = debug_sensor_bin; }
       void read_register_service(std::string register_number_str, int size);
       void write_register_service(std::string register_number_str, std::string value_str);
+      void read_registers_service(std::vector<int32_t> registers, std::vector<int32_t> sizes);
+      void write_registers_service(std::vector<int32_t> registers, std::vector<int32_t> values,
+                                   std::vector<int32_t> sizes);
       void set_calibration_mode(bool state);
 
     protected:
@@ -62,6 +159,10 @@ namespace esphome {
       text_sensor::TextSensor *debug_sensor_bin_{nullptr};
       sensor::Sensor *energy_received_{nullptr};
       sensor::Sensor *energy_exported_{nullptr};
+      sensor::Sensor *sampling_rate_sensor_{nullptr};
+      sensor::Sensor *trip_latency_sensor_{nullptr};
+      text_sensor::TextSensor *load_event_text_sensor_{nullptr};
+      sensor::Sensor *load_event_delta_sensor_{nullptr};
       CSE7761DataStruct data_;
       esphome::ESPPreferenceObject pref_;
       // calibration
@@ -70,6 +171,7 @@ namespace esphome {
       uint8_t calibration_count_{0};
       double sum_current_B_{0};
       double sum_power_B_{0};
+      double voltage_{0};
       double active_current_A_{0};
       double active_current_B_{0};
       double last_active_power_A_{0};
@@ -83,15 +185,87 @@ namespace esphome {
       uint32_t last_save_time_{0};
       double accumulated_energy_received_{0.0f};
       double accumulated_energy_exported_{0.0f};
+      // raw sample filters
+      FilterChain<CSE7761_VOLTAGE_FILTERS> voltage_filter_;
+      FilterChain<CSE7761_CURRENT_1_FILTERS> current_1_filter_;
+      FilterChain<CSE7761_CURRENT_2_FILTERS> current_2_filter_;
+      FilterChain<CSE7761_ACTIVE_POWER_1_FILTERS> active_power_1_filter_;
+      FilterChain<CSE7761_ACTIVE_POWER_2_FILTERS> active_power_2_filter_;
+      // adaptive polling
+      bool adaptive_polling_{false};
+      uint32_t adaptive_min_interval_{0};
+      uint32_t adaptive_max_interval_{0};
+      float power_step_threshold_{0};
+      uint32_t adaptive_probe_interval_{0};
+      double last_probe_power_{0};
+      // over-current / over-power protection (thresholds at 0 are disabled)
+      float protection_current_threshold_{0};
+      float protection_power_threshold_{0};
+      uint32_t protection_trip_delay_{0};
+      float protection_hysteresis_{0};
+#ifdef USE_SWITCH
+      switch_::Switch *protection_switch_{nullptr};
+#endif
+#ifdef USE_OUTPUT
+      output::BinaryOutput *protection_output_{nullptr};
+#endif
+      bool protection_tripped_{false};
+      bool overload_{false};
+      uint32_t overload_start_time_{0};
+      uint32_t last_safe_sample_time_{0};
+      uint32_t last_protection_sample_time_{0};
+      uint32_t fast_read_failures_{0};
+      // fast sampling path (protection and load events)
+      uint32_t last_fast_sample_time_{0};
+      // load events detection
+      bool load_events_enabled_{false};
+      float load_event_threshold_{0};
+      uint32_t load_event_settle_time_{0};
+      bool load_baseline_ready_{false};
+      double load_baseline_{0};
+      double cusum_pos_{0};
+      double cusum_neg_{0};
+      bool load_settling_{false};
+      uint32_t load_change_time_{0};
+      double load_settle_sum_{0};
+      uint32_t load_settle_count_{0};
+      // measurements streaming
+      std::string stream_host_;
+      uint16_t stream_port_{0};
+      uint8_t stream_batch_size_{1};
+      bool stream_raw_{false};
+      std::unique_ptr<socket::Socket> stream_socket_;
+      struct sockaddr_storage stream_addr_;
+      socklen_t stream_addr_len_{0};
+      std::vector<uint8_t> stream_buffer_;
+      uint32_t stream_sequence_{0};
+      uint32_t stream_max_delay_{0};
+      uint32_t stream_first_sample_time_{0};
 
       void write_(uint8_t reg, uint16_t data);
       bool read_once_(uint8_t reg, uint8_t size, uint32_t *value);
       uint32_t read_(uint8_t reg, uint8_t size);
+      bool try_read_(uint8_t reg, uint8_t size, uint32_t *value);
       uint32_t coefficient_by_unit_(uint32_t unit);
       bool chip_init_();
       void get_data_();
       std::vector<uint8_t> read_register(int reg, int size);
+      void read_batch_(std::vector<uint8_t> &frames, std::vector<RegisterResultStruct> &results);
+      void fire_registers_event_(const std::string &event_name, const std::vector<RegisterResultStruct> &results);
       void perform_calibration_write_();
+      void adapt_update_interval_(double power_step);
+      double current_A_from_raw_(int32_t raw);
+      double power_A_from_raw_(int32_t raw);
+      bool protection_enabled_() const {
+        return this->protection_current_threshold_ > 0 || this->protection_power_threshold_ > 0;
+      }
+      void check_protection_(double current, double power, uint32_t now);
+      void trip_protection_(double current, double power, uint32_t latency_start, const char *reason);
+      void detect_load_event_(double power, uint32_t now);
+      void publish_load_event_(double delta, double before, double after);
+      void stream_setup_();
+      void stream_sample_(uint32_t now);
+      void stream_flush_();
     };
 
   }  // namespace cse7761
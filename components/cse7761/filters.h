@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+
+namespace esphome {
+  namespace cse7761 {
+
+    /*********************************************************************************************\
+     * Raw sample filters
+     *
+     * Header only filters applied on every raw measurement, before publication, energy
+     * integration and streaming. Parameters are template arguments (floats are given in
+     * millionths) so every chain built by sensor.py is a fixed size type that the compiler
+     * can inline completely. Filters keep the first sample as initial state.
+     * \*********************************************************************************************/
+
+    //***********************************************************************************************
+    // MovingAverageFilter : mean of the last N samples (mean of the available ones at start).
+    // The running sum is recomputed from the window once per turn so that rounding errors can't
+    // build up (a long run then zeros would not give exactly 0 otherwise)
+    //***********************************************************************************************
+    template<size_t N> class MovingAverageFilter {
+      static_assert(N >= 1, "MovingAverageFilter needs at least one sample");
+
+    public:
+      float apply(float value) {
+        this->sum_ += value - this->window_[this->index_];
+        this->window_[this->index_] = value;
+        this->index_ = (this->index_ + 1 == N) ? 0 : this->index_ + 1;
+        this->count_ += (this->count_ < N);
+        if (this->index_ == 0) {
+          float sum = 0;
+          for (size_t i = 0; i < N; i++) {
+            sum += this->window_[i];
+          }
+          this->sum_ = sum;
+        }
+        return this->sum_ / this->count_;
+      }
+
+    protected:
+      float window_[N] = {0};
+      float sum_{0};
+      size_t index_{0};
+      size_t count_{0};
+    };
+
+    //***********************************************************************************************
+    // ExponentialFilter : y += alpha * (x - y), with alpha = ALPHA_E6 / 1e6
+    //***********************************************************************************************
+    template<uint32_t ALPHA_E6> class ExponentialFilter {
+      static_assert(ALPHA_E6 > 0 && ALPHA_E6 <= 1000000, "ExponentialFilter alpha must be in ]0, 1]");
+
+    public:
+      float apply(float value) {
+        constexpr float alpha = ALPHA_E6 / 1e6f;
+        // first sample: weight 1, then alpha
+        float weight = this->primed_ ? alpha : 1.0f;
+        this->primed_ = true;
+        this->state_ += weight * (value - this->state_);
+        return this->state_;
+      }
+
+    protected:
+      float state_{0};
+      bool primed_{false};
+    };
+
+    //***********************************************************************************************
+    // MedianFilter : median of the last N samples (N odd). Rank based selection: O(N²) without
+    // data dependent branches, cheaper than a sort for the small N accepted by sensor.py
+    //***********************************************************************************************
+    template<size_t N> class MedianFilter {
+      static_assert(N % 2 == 1, "MedianFilter needs an odd number of samples");
+
+    public:
+      float apply(float value) {
+        if (!this->primed_) {
+          for (size_t i = 0; i < N; i++) {
+            this->window_[i] = value;
+          }
+          this->primed_ = true;
+        }
+        this->window_[this->index_] = value;
+        this->index_ = (this->index_ + 1 == N) ? 0 : this->index_ + 1;
+
+        float median = 0;
+        for (size_t i = 0; i < N; i++) {
+          size_t rank = 0;
+          for (size_t j = 0; j < N; j++) {
+            // ties are broken by position so that exactly one sample has rank N / 2
+            rank += (this->window_[j] < this->window_[i]) | ((this->window_[j] == this->window_[i]) & (j < i));
+          }
+          median += (rank == N / 2) * this->window_[i];
+        }
+        return median;
+      }
+
+    protected:
+      float window_[N] = {0};
+      size_t index_{0};
+      bool primed_{false};
+    };
+
+    //***********************************************************************************************
+    // DeadZoneFilter : force to 0 the values in ]-width, width[, with width = WIDTH_E6 / 1e6
+    //***********************************************************************************************
+    template<uint32_t WIDTH_E6> class DeadZoneFilter {
+    public:
+      float apply(float value) {
+        constexpr float width = WIDTH_E6 / 1e6f;
+        return (std::fabs(value) < width) ? 0.0f : value;
+      }
+    };
+
+    //***********************************************************************************************
+    // FilterChain : apply the filters in declaration order. FilterChain<> does nothing.
+    //***********************************************************************************************
+    template<typename... Filters> class FilterChain {
+    public:
+      float apply(float value) {
+        std::apply([&value](auto &...filter) { ((value = filter.apply(value)), ...); }, this->filters_);
+        return value;
+      }
+
+    protected:
+      std::tuple<Filters...> filters_;
+    };
+
+  }  // namespace cse7761
+}  // namespace esphome
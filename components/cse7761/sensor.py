@@ -1,19 +1,29 @@
 import esphome.codegen as cg
-from esphome.components import sensor, uart, text_sensor, api
+from esphome.components import sensor, uart, text_sensor, api, output, switch
 import esphome.config_validation as cv
 from esphome.const import (
     CONF_ID,
+    CONF_CURRENT,
+    CONF_HOST,
+    CONF_OUTPUT_ID,
+    CONF_PORT,
+    CONF_POWER,
     CONF_VOLTAGE,
     DEVICE_CLASS_CURRENT,
     DEVICE_CLASS_POWER,
     DEVICE_CLASS_VOLTAGE,
     DEVICE_CLASS_ENERGY,
+    DEVICE_CLASS_FREQUENCY,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    DEVICE_CLASS_DURATION,
     STATE_CLASS_MEASUREMENT,
     STATE_CLASS_TOTAL_INCREASING,
     UNIT_AMPERE,
     UNIT_VOLT,
     UNIT_WATT,
     UNIT_KILOWATT_HOURS,
+    UNIT_HERTZ,
+    UNIT_MILLISECOND,
 )
 
 CODEOWNERS = ["@berfenger", "@mazkagaz"]
@@ -31,6 +41,170 @@ CONF_ENERGY_RECEIVED = "energy_received"
 CONF_ENERGY_EXPORTED = "energy_exported"
 CONF_DEBUG_SENSOR_HEX_ID = "debug_sensor_hex_id"
 CONF_DEBUG_SENSOR_BIN_ID = "debug_sensor_bin_id"
+CONF_SAMPLING_RATE = "sampling_rate"
+CONF_ADAPTIVE_POLLING = "adaptive_polling"
+CONF_MIN_INTERVAL = "min_interval"
+CONF_MAX_INTERVAL = "max_interval"
+CONF_POWER_STEP_THRESHOLD = "power_step_threshold"
+CONF_PROBE_INTERVAL = "probe_interval"
+CONF_STREAM = "stream"
+CONF_BATCH_SIZE = "batch_size"
+CONF_MAX_DELAY = "max_delay"
+CONF_RAW = "raw"
+CONF_RAW_FILTERS = "raw_filters"
+CONF_MOVING_AVERAGE = "moving_average"
+CONF_EXPONENTIAL = "exponential"
+CONF_MEDIAN = "median"
+CONF_DEAD_ZONE = "dead_zone"
+CONF_PROTECTION = "protection"
+CONF_TRIP_DELAY = "trip_delay"
+CONF_HYSTERESIS = "hysteresis"
+CONF_SWITCH_ID = "switch_id"
+CONF_TRIP_LATENCY = "trip_latency"
+CONF_LOAD_EVENTS = "load_events"
+CONF_THRESHOLD = "threshold"
+CONF_SETTLE_TIME = "settle_time"
+CONF_LAST_EVENT = "last_event"
+CONF_LAST_DELTA = "last_delta"
+
+
+def validate_odd(value):
+    if value % 2 == 0:
+        raise cv.Invalid("Must be an odd number")
+    return value
+
+
+def validate_millionths(value):
+    # filters.h takes floats in millionths: a non-zero value must not round to 0
+    if value != 0 and round(value * 1e6) < 1:
+        raise cv.Invalid("Must be 0 or at least 0.000001")
+    return value
+
+
+# Raw sample filters (see filters.h), applied in list order on every measurement
+RAW_FILTER_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(CONF_MOVING_AVERAGE): cv.int_range(min=2, max=64),
+            cv.Optional(CONF_EXPONENTIAL): cv.All(
+                cv.float_range(min=0.0, max=1.0, min_included=False),
+                validate_millionths,
+            ),
+            cv.Optional(CONF_MEDIAN): cv.All(cv.int_range(min=3, max=9), validate_odd),
+            cv.Optional(CONF_DEAD_ZONE): cv.All(
+                cv.float_range(min=0.0, max=4000.0), validate_millionths
+            ),
+        }
+    ),
+    cv.has_exactly_one_key(
+        CONF_MOVING_AVERAGE, CONF_EXPONENTIAL, CONF_MEDIAN, CONF_DEAD_ZONE
+    ),
+)
+
+RAW_FILTERS_SCHEMA = cv.Schema(
+    {cv.Optional(CONF_RAW_FILTERS): cv.ensure_list(RAW_FILTER_SCHEMA)}
+)
+
+
+def raw_filter_chain(filters):
+    """C++ template arguments of the FilterChain built from a raw_filters list."""
+    types = []
+    for conf in filters:
+        if CONF_MOVING_AVERAGE in conf:
+            types.append(f"esphome::cse7761::MovingAverageFilter<{conf[CONF_MOVING_AVERAGE]}>")
+        elif CONF_EXPONENTIAL in conf:
+            alpha = round(conf[CONF_EXPONENTIAL] * 1e6)
+            types.append(f"esphome::cse7761::ExponentialFilter<{alpha}>")
+        elif CONF_MEDIAN in conf:
+            types.append(f"esphome::cse7761::MedianFilter<{conf[CONF_MEDIAN]}>")
+        elif CONF_DEAD_ZONE in conf:
+            width = round(conf[CONF_DEAD_ZONE] * 1e6)
+            types.append(f"esphome::cse7761::DeadZoneFilter<{width}>")
+    return ", ".join(types)
+
+
+def validate_adaptive_polling(config):
+    if config[CONF_MIN_INTERVAL] > config[CONF_MAX_INTERVAL]:
+        raise cv.Invalid(f"{CONF_MIN_INTERVAL} must be lower than {CONF_MAX_INTERVAL}")
+    return config
+
+
+# CSE7761 power registers are updated at 27.2Hz: no need to poll faster than ~37ms
+ADAPTIVE_POLLING_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(CONF_MIN_INTERVAL, default="100ms"): cv.All(
+                cv.positive_time_period_milliseconds,
+                cv.Range(min=cv.TimePeriod(milliseconds=37)),
+            ),
+            cv.Optional(CONF_MAX_INTERVAL, default="10s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_POWER_STEP_THRESHOLD, default=20.0): cv.positive_not_null_float,
+            # opt-in: every probe is one more blocking UART read
+            cv.Optional(CONF_PROBE_INTERVAL): cv.All(
+                cv.positive_time_period_milliseconds,
+                cv.Range(min=cv.TimePeriod(milliseconds=37)),
+            ),
+        }
+    ),
+    validate_adaptive_polling,
+)
+
+# 8 bytes header + 28 bytes per sample: 32 samples keep a datagram under the 1472 bytes MTU.
+# No AUTO_LOAD of "socket": the api component (in DEPENDENCIES) already loads it.
+STREAM_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_HOST): cv.ipv4address,
+        cv.Required(CONF_PORT): cv.port,
+        cv.Optional(CONF_BATCH_SIZE, default=4): cv.int_range(min=1, max=32),
+        cv.Optional(CONF_MAX_DELAY, default="500ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_RAW, default=False): cv.boolean,
+    }
+)
+
+
+# Over-current / over-power protection, evaluated on every channel A raw sample
+PROTECTION_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(CONF_CURRENT): cv.positive_not_null_float,
+            cv.Optional(CONF_POWER): cv.positive_not_null_float,
+            cv.Optional(CONF_TRIP_DELAY, default="0ms"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_HYSTERESIS, default="10%"): cv.percentage,
+            cv.Optional(CONF_SWITCH_ID): cv.use_id(switch.Switch),
+            cv.Optional(CONF_OUTPUT_ID): cv.use_id(output.BinaryOutput),
+            # upper bound: from the last sample below the thresholds to the relay command
+            cv.Optional(CONF_TRIP_LATENCY): sensor.sensor_schema(
+                unit_of_measurement=UNIT_MILLISECOND,
+                accuracy_decimals=0,
+                device_class=DEVICE_CLASS_DURATION,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+        }
+    ),
+    cv.has_at_least_one_key(CONF_CURRENT, CONF_POWER),
+    cv.has_exactly_one_key(CONF_SWITCH_ID, CONF_OUTPUT_ID),
+)
+
+
+# Load events (step changes of channel A active power), detected on the fast sampling path
+LOAD_EVENTS_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_THRESHOLD, default=50.0): cv.positive_not_null_float,
+        cv.Optional(CONF_SETTLE_TIME, default="2s"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(milliseconds=100)),
+        ),
+        cv.Optional(CONF_LAST_EVENT): text_sensor.text_sensor_schema(
+            icon="mdi:transit-connection-variant",
+        ),
+        cv.Optional(CONF_LAST_DELTA): sensor.sensor_schema(
+            unit_of_measurement=UNIT_WATT,
+            accuracy_decimals=1,
+            device_class=DEVICE_CLASS_POWER,
+        ),
+    }
+)
+
 
 CONFIG_SCHEMA = (
     cv.Schema(
@@ -41,31 +215,31 @@ CONFIG_SCHEMA = (
                 accuracy_decimals=1,
                 device_class=DEVICE_CLASS_VOLTAGE,
                 state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            ).extend(RAW_FILTERS_SCHEMA),
             cv.Optional(CONF_CURRENT_1): sensor.sensor_schema(
                 unit_of_measurement=UNIT_AMPERE,
                 accuracy_decimals=2,
                 device_class=DEVICE_CLASS_CURRENT,
                 state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            ).extend(RAW_FILTERS_SCHEMA),
             cv.Optional(CONF_CURRENT_2): sensor.sensor_schema(
                 unit_of_measurement=UNIT_AMPERE,
                 accuracy_decimals=2,
                 device_class=DEVICE_CLASS_CURRENT,
                 state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            ).extend(RAW_FILTERS_SCHEMA),
             cv.Optional(CONF_ACTIVE_POWER_1): sensor.sensor_schema(
                 unit_of_measurement=UNIT_WATT,
                 accuracy_decimals=1,
                 device_class=DEVICE_CLASS_POWER,
                 state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            ).extend(RAW_FILTERS_SCHEMA),
             cv.Optional(CONF_ACTIVE_POWER_2): sensor.sensor_schema(
                 unit_of_measurement=UNIT_WATT,
                 accuracy_decimals=1,
                 device_class=DEVICE_CLASS_POWER,
                 state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            ).extend(RAW_FILTERS_SCHEMA),
             cv.Optional(CONF_ENERGY_RECEIVED): sensor.sensor_schema(
                 unit_of_measurement=UNIT_KILOWATT_HOURS,
                 accuracy_decimals=3,
@@ -78,6 +252,17 @@ CONFIG_SCHEMA = (
                 device_class=DEVICE_CLASS_ENERGY,
                 state_class=STATE_CLASS_TOTAL_INCREASING,
             ),
+            cv.Optional(CONF_SAMPLING_RATE): sensor.sensor_schema(
+                unit_of_measurement=UNIT_HERTZ,
+                accuracy_decimals=2,
+                device_class=DEVICE_CLASS_FREQUENCY,
+                state_class=STATE_CLASS_MEASUREMENT,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_ADAPTIVE_POLLING): ADAPTIVE_POLLING_SCHEMA,
+            cv.Optional(CONF_STREAM): STREAM_SCHEMA,
+            cv.Optional(CONF_PROTECTION): PROTECTION_SCHEMA,
+            cv.Optional(CONF_LOAD_EVENTS): LOAD_EVENTS_SCHEMA,
             cv.Optional(CONF_DEBUG_SENSOR_HEX_ID): cv.use_id(text_sensor.TextSensor),
             cv.Optional(CONF_DEBUG_SENSOR_BIN_ID): cv.use_id(text_sensor.TextSensor),
         }
@@ -105,12 +290,68 @@ async def to_code(config):
         CONF_ACTIVE_POWER_2,
         CONF_ENERGY_RECEIVED,
         CONF_ENERGY_EXPORTED,
+        CONF_SAMPLING_RATE,
     ]:
         if key not in config:
             continue
         conf = config[key]
         sens = await sensor.new_sensor(conf)
         cg.add(getattr(var, f"set_{key}_sensor")(sens))
+        if raw_filters := conf.get(CONF_RAW_FILTERS):
+            cg.add_define(
+                f"CSE7761_{key.upper()}_FILTERS",
+                cg.RawExpression(raw_filter_chain(raw_filters)),
+            )
+    if adaptive_config := config.get(CONF_ADAPTIVE_POLLING):
+        cg.add(
+            var.set_adaptive_polling(
+                adaptive_config[CONF_MIN_INTERVAL],
+                adaptive_config[CONF_MAX_INTERVAL],
+                adaptive_config[CONF_POWER_STEP_THRESHOLD],
+                adaptive_config.get(CONF_PROBE_INTERVAL, 0),
+            )
+        )
+    if stream_config := config.get(CONF_STREAM):
+        cg.add(
+            var.set_stream(
+                str(stream_config[CONF_HOST]),
+                stream_config[CONF_PORT],
+                stream_config[CONF_BATCH_SIZE],
+                stream_config[CONF_MAX_DELAY],
+                stream_config[CONF_RAW],
+            )
+        )
+    if protection_config := config.get(CONF_PROTECTION):
+        cg.add(
+            var.set_protection(
+                protection_config.get(CONF_CURRENT, 0.0),
+                protection_config.get(CONF_POWER, 0.0),
+                protection_config[CONF_TRIP_DELAY],
+                protection_config[CONF_HYSTERESIS],
+            )
+        )
+        if switch_config := protection_config.get(CONF_SWITCH_ID):
+            protection_switch = await cg.get_variable(switch_config)
+            cg.add(var.set_protection_switch(protection_switch))
+        if output_config := protection_config.get(CONF_OUTPUT_ID):
+            protection_output = await cg.get_variable(output_config)
+            cg.add(var.set_protection_output(protection_output))
+        if trip_latency_config := protection_config.get(CONF_TRIP_LATENCY):
+            sens = await sensor.new_sensor(trip_latency_config)
+            cg.add(var.set_trip_latency_sensor(sens))
+    if load_events_config := config.get(CONF_LOAD_EVENTS):
+        cg.add(
+            var.set_load_events(
+                load_events_config[CONF_THRESHOLD],
+                load_events_config[CONF_SETTLE_TIME],
+            )
+        )
+        if last_event_config := load_events_config.get(CONF_LAST_EVENT):
+            sens = await text_sensor.new_text_sensor(last_event_config)
+            cg.add(var.set_load_event_text_sensor(sens))
+        if last_delta_config := load_events_config.get(CONF_LAST_DELTA):
+            sens = await sensor.new_sensor(last_delta_config)
+            cg.add(var.set_load_event_delta_sensor(sens))
     if debug_sensor_hex_config := config.get(CONF_DEBUG_SENSOR_HEX_ID):
         debug_sensor_hex = await cg.get_variable(debug_sensor_hex_config)
         cg.add(var.set_debug_text_sensor_hex(debug_sensor_hex))